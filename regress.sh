@@ -0,0 +1,4 @@
+#! /bin/sh
+
+# Renders the reference poses and checks them against regress/ (pass --record to refresh the goldens)
+./configure.sh && ./build.sh && ./build/RT --regress regress "$@"
@@ -0,0 +1,292 @@
+#include "./headers/bvh.h"
+
+#include <algorithm>
+
+BVH::BVH(float rebuildThreshold)
+    : root(-1), innerArea(0.0f), builtCost(0.0f), rebuildThreshold(rebuildThreshold), rebuildCount(0) {}
+
+void BVH::build(const std::vector<Object *> &sceneObjects)
+{
+    objects = sceneObjects;
+    dynamicObjects.clear();
+    isDynamicObject.assign(objects.size(), false);
+    pendingMoves.clear();
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        objects[i]->owner = this;
+        objects[i]->ownerIndex = static_cast<int>(i);
+        if (objects[i]->isDynamic())
+        {
+            markDynamic(static_cast<int>(i));
+        }
+    }
+    rebuild();
+}
+
+void BVH::markMoved(int object)
+{
+    pendingMoves.push_back(object);
+}
+
+void BVH::markDynamic(int object)
+{
+    if (!isDynamicObject[object])
+    {
+        isDynamicObject[object] = true;
+        dynamicObjects.push_back(object);
+    }
+}
+
+void BVH::animate(float deltaTime)
+{
+    movedScratch.swap(pendingMoves);
+    pendingMoves.clear();
+    for (int object : dynamicObjects)
+    {
+        if (objects[object]->update(deltaTime))
+        {
+            movedScratch.push_back(object);
+        }
+    }
+    update(movedScratch);
+    movedScratch.clear();
+}
+
+void Object::notifyMoved()
+{
+    if (owner)
+    {
+        owner->markMoved(ownerIndex);
+    }
+}
+
+void Object::notifyDynamic()
+{
+    if (owner)
+    {
+        owner->markDynamic(ownerIndex);
+    }
+}
+
+void BVH::rebuild()
+{
+    nodes.clear();
+    leafOfObject.assign(objects.size(), -1);
+    innerArea = 0.0f;
+    root = -1;
+
+    if (!objects.empty())
+    {
+        nodes.reserve(2 * objects.size() - 1);
+        std::vector<int> indices(objects.size());
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            indices[i] = static_cast<int>(i);
+        }
+        root = buildRange(indices, 0, static_cast<int>(indices.size()), -1);
+    }
+
+    builtCost = cost();
+    rebuildCount++;
+}
+
+// Top-down build: splits at the median centroid along the widest axis
+int BVH::buildRange(std::vector<int> &indices, int begin, int end, int parent)
+{
+    int nodeIndex = static_cast<int>(nodes.size());
+    nodes.push_back(Node{AABB(), -1, -1, parent, -1, -1});
+
+    if (end - begin == 1)
+    {
+        int object = indices[begin];
+        nodes[nodeIndex].bounds = objects[object]->getBounds();
+        nodes[nodeIndex].object = object;
+        nodes[nodeIndex].minObject = object;
+        leafOfObject[object] = nodeIndex;
+        return nodeIndex;
+    }
+
+    AABB centroidBounds;
+    for (int i = begin; i < end; ++i)
+    {
+        glm::vec3 center = objects[indices[i]]->getBounds().center();
+        centroidBounds = centroidBounds.merge(AABB(center, center));
+    }
+    glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+    int axis = 0;
+    if (extent.y > extent.x)
+        axis = 1;
+    if (extent.z > extent[axis])
+        axis = 2;
+
+    int middle = begin + (end - begin) / 2;
+    std::nth_element(indices.begin() + begin, indices.begin() + middle, indices.begin() + end,
+                     [&](int a, int b)
+                     { return objects[a]->getBounds().center()[axis] < objects[b]->getBounds().center()[axis]; });
+
+    int left = buildRange(indices, begin, middle, nodeIndex);
+    int right = buildRange(indices, middle, end, nodeIndex);
+
+    Node &node = nodes[nodeIndex];
+    node.left = left;
+    node.right = right;
+    node.bounds = nodes[left].bounds.merge(nodes[right].bounds);
+    node.minObject = std::min(nodes[left].minObject, nodes[right].minObject);
+    innerArea += node.bounds.surfaceArea();
+    return nodeIndex;
+}
+
+// Surface area heuristic of the inner nodes relative to the root
+float BVH::cost() const
+{
+    if (root < 0)
+    {
+        return 0.0f;
+    }
+    float rootArea = nodes[root].bounds.surfaceArea();
+    return rootArea > 0.0f ? innerArea / rootArea : 0.0f;
+}
+
+void BVH::update(const std::vector<int> &movedObjects)
+{
+    if (movedObjects.empty())
+    {
+        return;
+    }
+
+    for (int object : movedObjects)
+    {
+        int nodeIndex = leafOfObject[object];
+        nodes[nodeIndex].bounds = objects[object]->getBounds();
+
+        // Walk up until a node's bounds stop changing; everything above it is already correct
+        for (int parent = nodes[nodeIndex].parent; parent >= 0; parent = nodes[parent].parent)
+        {
+            Node &node = nodes[parent];
+            AABB refitted = nodes[node.left].bounds.merge(nodes[node.right].bounds);
+            if (refitted == node.bounds)
+            {
+                break;
+            }
+            innerArea += refitted.surfaceArea() - node.bounds.surfaceArea();
+            node.bounds = refitted;
+        }
+    }
+
+    if (cost() > builtCost * rebuildThreshold)
+    {
+        rebuild();
+    }
+}
+
+Object *BVH::intersect(const glm::vec3 &rayOrigin, const glm::vec3 &rayDirection, Intersect &result,
+                       const Object *ignore, float minDistance) const
+{
+    Object *hitObject = nullptr;
+    if (root < 0)
+    {
+        return hitObject;
+    }
+
+    glm::vec3 invDir = 1.0f / rayDirection;
+    float zBuffer = std::numeric_limits<float>::infinity();
+    int hitIndex = static_cast<int>(objects.size());
+
+    int stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = root;
+
+    while (stackSize > 0)
+    {
+        const Node &node = nodes[stack[--stackSize]];
+        // A subtree entered exactly at the current distance can still win the tie on index
+        float entry = node.bounds.rayEntry(rayOrigin, invDir);
+        if (entry == std::numeric_limits<float>::infinity() || entry > zBuffer ||
+            (entry == zBuffer && node.minObject >= hitIndex))
+        {
+            continue;
+        }
+
+        if (node.object >= 0)
+        {
+            Object *obj = objects[node.object];
+            if (obj == ignore)
+            {
+                continue;
+            }
+            Intersect tempIntersect = obj->rayIntersect(rayOrigin, rayDirection);
+            if (tempIntersect.isIntersecting && tempIntersect.distance > minDistance &&
+                (tempIntersect.distance < zBuffer || (tempIntersect.distance == zBuffer && node.object < hitIndex)))
+            {
+                zBuffer = tempIntersect.distance;
+                hitIndex = node.object;
+                result = tempIntersect;
+                hitObject = obj;
+            }
+            continue;
+        }
+
+        stack[stackSize++] = node.left;
+        stack[stackSize++] = node.right;
+    }
+
+    return hitObject;
+}
+
+Object *BVH::intersectFirst(const glm::vec3 &rayOrigin, const glm::vec3 &rayDirection, Intersect &result,
+                            const Object *ignore, float minDistance) const
+{
+    Object *hitObject = nullptr;
+    if (root < 0)
+    {
+        return hitObject;
+    }
+
+    glm::vec3 invDir = 1.0f / rayDirection;
+    int firstObject = static_cast<int>(objects.size());
+
+    int stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = root;
+
+    while (stackSize > 0)
+    {
+        const Node &node = nodes[stack[--stackSize]];
+        // Subtrees holding only later objects cannot improve the result
+        if (node.minObject >= firstObject || node.bounds.rayEntry(rayOrigin, invDir) == std::numeric_limits<float>::infinity())
+        {
+            continue;
+        }
+
+        if (node.object >= 0)
+        {
+            Object *obj = objects[node.object];
+            if (obj == ignore)
+            {
+                continue;
+            }
+            Intersect tempIntersect = obj->rayIntersect(rayOrigin, rayDirection);
+            if (tempIntersect.isIntersecting && tempIntersect.distance > minDistance)
+            {
+                firstObject = node.object;
+                result = tempIntersect;
+                hitObject = obj;
+            }
+            continue;
+        }
+
+        // Visit the subtree with the earlier objects first so later ones are pruned sooner
+        if (nodes[node.left].minObject < nodes[node.right].minObject)
+        {
+            stack[stackSize++] = node.right;
+            stack[stackSize++] = node.left;
+        }
+        else
+        {
+            stack[stackSize++] = node.left;
+            stack[stackSize++] = node.right;
+        }
+    }
+
+    return hitObject;
+}
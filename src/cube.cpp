@@ -1,7 +1,46 @@
 #include "./headers/cube.h"
 
 Cube::Cube(const glm::vec3 &minCorner, const glm::vec3 &dimensions, const Material &mat)
-    : Object(mat), minCorner(minCorner), dimensions(dimensions) {}
+    : Object(mat), minCorner(minCorner), dimensions(dimensions), motion(nullptr), motionTime(0.0f) {}
+
+AABB Cube::getBounds() const
+{
+    return AABB(minCorner, minCorner + dimensions);
+}
+
+void Cube::setPosition(const glm::vec3 &corner)
+{
+    minCorner = corner;
+    notifyMoved();
+}
+
+void Cube::setMotion(const std::function<glm::vec3(float)> &path)
+{
+    motion = path;
+    motionTime = 0.0f;
+    if (motion)
+    {
+        notifyDynamic();
+    }
+}
+
+// Avanza la trayectoria y devuelve true si el cubo cambió de posición
+bool Cube::update(float deltaTime)
+{
+    if (!motion)
+    {
+        return false;
+    }
+
+    motionTime += deltaTime;
+    glm::vec3 corner = motion(motionTime);
+    if (corner == minCorner)
+    {
+        return false;
+    }
+    minCorner = corner;
+    return true;
+}
 
 // Método para calcular la intersección del rayo con el cubo
 Intersect Cube::rayIntersect(const glm::vec3 &rayOrigin, const glm::vec3 &rayDirection) const
@@ -9,6 +48,10 @@ Intersect Cube::rayIntersect(const glm::vec3 &rayOrigin, const glm::vec3 &rayDir
     glm::vec3 invDir = 1.0f / rayDirection;
     glm::vec3 t0 = (minCorner - rayOrigin) * invDir;
     glm::vec3 t1 = (minCorner + dimensions - rayOrigin) * invDir;
+    if (AABB::liesInFacePlane(t0, t1))
+    {
+        return Intersect(); // El rayo solo roza el cubo
+    }
 
     glm::vec3 tmin = glm::min(t0, t1);
     glm::vec3 tmax = glm::max(t0, t1);
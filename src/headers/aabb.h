@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cmath>
+#include <glm/glm.hpp>
+#include <limits>
+
+// Axis-aligned bounding box used by the acceleration structure
+struct AABB
+{
+    glm::vec3 min;
+    glm::vec3 max;
+
+    AABB()
+        : min(std::numeric_limits<float>::infinity()),
+          max(-std::numeric_limits<float>::infinity()) {}
+    AABB(const glm::vec3 &minCorner, const glm::vec3 &maxCorner) : min(minCorner), max(maxCorner) {}
+
+    // Returns the smallest box containing both boxes
+    AABB merge(const AABB &other) const
+    {
+        return AABB(glm::min(min, other.min), glm::max(max, other.max));
+    }
+
+    glm::vec3 center() const { return 0.5f * (min + max); }
+
+    float surfaceArea() const
+    {
+        glm::vec3 extent = max - min;
+        return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+    }
+
+    // Slab test: returns the entry distance, or infinity when the ray misses or the box is behind it
+    float rayEntry(const glm::vec3 &rayOrigin, const glm::vec3 &invDirection) const
+    {
+        glm::vec3 t0 = (min - rayOrigin) * invDirection;
+        glm::vec3 t1 = (max - rayOrigin) * invDirection;
+        if (liesInFacePlane(t0, t1))
+        {
+            return std::numeric_limits<float>::infinity();
+        }
+
+        glm::vec3 tmin = glm::min(t0, t1);
+        glm::vec3 tmax = glm::max(t0, t1);
+
+        float tNear = glm::max(tmin.x, glm::max(tmin.y, tmin.z));
+        float tFar = glm::min(tmax.x, glm::min(tmax.y, tmax.z));
+
+        if (tNear > tFar || tFar < 0)
+        {
+            return std::numeric_limits<float>::infinity();
+        }
+        return tNear;
+    }
+
+    // A ray lying exactly in a face plane gets 0 * inf = NaN for that slab. Box tests count it as a
+    // miss (the ray only grazes the box) instead of letting the NaN decide.
+    static bool liesInFacePlane(const glm::vec3 &t0, const glm::vec3 &t1)
+    {
+        return std::isnan(t0.x) || std::isnan(t0.y) || std::isnan(t0.z) ||
+               std::isnan(t1.x) || std::isnan(t1.y) || std::isnan(t1.z);
+    }
+
+    bool operator==(const AABB &other) const { return min == other.min && max == other.max; }
+    bool operator!=(const AABB &other) const { return !(*this == other); }
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <limits>
+#include <vector>
+#include "aabb.h"
+#include "intersect.h"
+#include "object.h"
+
+// Bounding volume hierarchy over the scene objects (one object per leaf).
+// Moving objects are handled by refitting only the leaves that moved and their ancestors;
+// the tree is rebuilt from scratch once refitting has degraded its quality past a threshold.
+class BVH
+{
+public:
+    // rebuildThreshold: relative growth of the tree cost (SAH) allowed before a full rebuild
+    explicit BVH(float rebuildThreshold = 1.5f);
+
+    void build(const std::vector<Object *> &sceneObjects);
+
+    // Refits the nodes above the given object indices; cost is proportional to movedObjects.size() * depth
+    void update(const std::vector<int> &movedObjects);
+
+    // Advances the dynamic objects only and refits what moved, including objects moved explicitly
+    // (e.g. Cube::setPosition) since the last call. Cost scales with the number of dynamic objects.
+    void animate(float deltaTime);
+
+    // Called through Object::notifyMoved / notifyDynamic
+    void markMoved(int object);
+    void markDynamic(int object);
+
+    // Returns the closest object hit farther than minDistance (nullptr if none) and fills result.
+    // Hits at exactly the same distance go to the object first in scene order, like a linear scan.
+    // The ignored object is skipped, which is used to avoid self-shadowing.
+    Object *intersect(const glm::vec3 &rayOrigin, const glm::vec3 &rayDirection, Intersect &result,
+                      const Object *ignore = nullptr,
+                      float minDistance = -std::numeric_limits<float>::infinity()) const;
+
+    // Returns the hit farther than minDistance on the object that comes first in scene order (nullptr
+    // if none), rather than the closest one. Shadows use this to keep their original first-occluder rule.
+    Object *intersectFirst(const glm::vec3 &rayOrigin, const glm::vec3 &rayDirection, Intersect &result,
+                           const Object *ignore, float minDistance) const;
+
+    const std::vector<Object *> &getObjects() const { return objects; }
+    int getRebuildCount() const { return rebuildCount; }
+
+private:
+    struct Node
+    {
+        AABB bounds;
+        int left;
+        int right;
+        int parent;
+        int object;    // Index into objects for leaves, -1 for inner nodes
+        int minObject; // Lowest object index in the subtree, used by intersectFirst
+    };
+
+    std::vector<Node> nodes;
+    std::vector<int> leafOfObject;
+    std::vector<Object *> objects;
+    std::vector<int> dynamicObjects;
+    std::vector<bool> isDynamicObject;
+    std::vector<int> pendingMoves;
+    std::vector<int> movedScratch;
+    int root;
+
+    // Sum of inner node surface areas, kept up to date during refits to track tree quality
+    float innerArea;
+    float builtCost;
+    float rebuildThreshold;
+    int rebuildCount;
+
+    void rebuild();
+    int buildRange(std::vector<int> &indices, int begin, int end, int parent);
+    float cost() const;
+};
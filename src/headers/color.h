@@ -23,14 +23,14 @@ struct Color
             std::min(255, int(a) + int(other.a)));
     }
 
-    // Overload the * operator to scale colors by a factor
+    // Overload the * operator to scale colors by a factor (clamped before narrowing so factors > 1 saturate)
     Color operator*(float factor) const
     {
         return Color(
-            std::clamp(static_cast<Uint8>(r * factor), Uint8(0), Uint8(255)),
-            std::clamp(static_cast<Uint8>(g * factor), Uint8(0), Uint8(255)),
-            std::clamp(static_cast<Uint8>(b * factor), Uint8(0), Uint8(255)),
-            std::clamp(static_cast<Uint8>(a * factor), Uint8(0), Uint8(255)));
+            static_cast<Uint8>(std::clamp(r * factor, 0.0f, 255.0f)),
+            static_cast<Uint8>(std::clamp(g * factor, 0.0f, 255.0f)),
+            static_cast<Uint8>(std::clamp(b * factor, 0.0f, 255.0f)),
+            static_cast<Uint8>(std::clamp(a * factor, 0.0f, 255.0f)));
     }
 
     // Declare the << operator to print colors
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <functional>
 #include "object.h"
 #include "material.h"
 #include "intersect.h"
@@ -13,8 +14,22 @@ public:
 
     // Método para calcular la intersección del rayo con el cubo
     Intersect rayIntersect(const glm::vec3 &rayOrigin, const glm::vec3 &rayDirection) const override;
+    AABB getBounds() const override;
+    bool isBox() const override { return true; }
+
+    // Mueve el cubo para que su esquina inferior quede en la posición indicada (el BVH se reajusta en el siguiente animate)
+    void setPosition(const glm::vec3 &corner);
+
+    // Asigna una trayectoria: la esquina inferior en función del tiempo transcurrido (segundos)
+    void setMotion(const std::function<glm::vec3(float)> &path);
+
+    bool update(float deltaTime) override;
+    bool isDynamic() const override { return static_cast<bool>(motion); }
 
 private:
     glm::vec3 minCorner;  // La esquina inferior del cubo
     glm::vec3 dimensions; // Dimensiones del cubo (longitud de cada lado)
+
+    std::function<glm::vec3(float)> motion; // Trayectoria opcional para cubos animados
+    float motionTime;                       // Tiempo acumulado de la animación
 };
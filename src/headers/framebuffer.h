@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "color.h"
+
+// Row-major image produced by the tracer and consumed by the presenter
+struct FrameBuffer
+{
+    int width;
+    int height;
+    std::vector<Color> pixels;
+
+    FrameBuffer(int w, int h) : width(w), height(h), pixels(w * h) {}
+
+    Color &at(int x, int y) { return pixels[y * width + x]; }
+    const Color &at(int x, int y) const { return pixels[y * width + x]; }
+
+    // Encodes the frame as a binary PPM (P6) image
+    std::string toPPM() const
+    {
+        std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+        std::string image;
+        image.reserve(header.size() + pixels.size() * 3);
+        image += header;
+        for (const Color &color : pixels)
+        {
+            image += static_cast<char>(color.r);
+            image += static_cast<char>(color.g);
+            image += static_cast<char>(color.b);
+        }
+        return image;
+    }
+};
@@ -2,17 +2,40 @@
 
 #include <glm/glm.hpp>
 #include "intersect.h"
+#include "aabb.h"
 #include "material.h"
 
+class BVH;
+
 class Object
 {
 public:
-    explicit Object(const Material &mat) : material(mat) {}
+    explicit Object(const Material &mat) : material(mat), owner(nullptr), ownerIndex(-1) {}
     virtual ~Object() = default;
 
     virtual Intersect rayIntersect(const glm::vec3 &rayOrigin, const glm::vec3 &rayDirection) const = 0;
+    virtual AABB getBounds() const = 0;
+
+    // True when the object is exactly its bounding box, which lets the rasteriser draw it
+    virtual bool isBox() const { return false; }
+
+    // Advances any animation by deltaTime seconds; returns true when the object moved
+    virtual bool update(float /* deltaTime */) { return false; }
+
+    // True for objects with an animation, which the BVH then updates every frame
+    virtual bool isDynamic() const { return false; }
+
     const Material &getMaterial() const { return material; }
 
 protected:
     Material material;
+
+    // Tell the BVH holding this object (if any) that it moved or became animated; defined in bvh.cpp
+    void notifyMoved();
+    void notifyDynamic();
+
+private:
+    friend class BVH;
+    BVH *owner;
+    int ownerIndex;
 };
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "bvh.h"
+#include "threadpool.h"
+
+#define RASTER_TILE_SIZE 32
+#define RASTER_NEAR_PLANE 0.001f
+#define RASTER_GUARD_BAND 1.1f // Clip frustum size relative to the visible screen
+#define RASTER_EDGE_TOLERANCE 0.01f // Pixels outside a triangle edge that still count as covered
+
+struct PrimaryRays;
+
+// What the primary ray of one pixel sees, as found by the rasteriser
+struct VisibilitySample
+{
+    int object;         // Index into the BVH objects, -1 when the pixel only sees the sky
+    int face;           // Box face: axis * 2 + (0 for the min side, 1 for the max side)
+    float inverseDepth; // 1 / view-space depth, larger is closer
+};
+
+// Visibility buffer filled by a tiled software rasteriser drawing the box faces of every object.
+// Replaces the BVH traversal of primary rays: each pixel only tests the box it sees.
+class VisibilityBuffer
+{
+public:
+    VisibilityBuffer(int width, int height);
+
+    // Rasterises the scene as seen by rays. Returns false when the pass cannot stand in for primary
+    // ray casting (a non-box object, or the camera inside a box); the buffer is then left unusable.
+    bool rasterize(const PrimaryRays &rays, const BVH &scene, ThreadPool &pool);
+
+    const VisibilitySample &at(int x, int y) const { return samples[y * width + x]; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    struct ScreenTriangle
+    {
+        glm::vec2 vertices[3]; // Screen coordinates; depth comes from the face plane
+        int object;
+        int face;
+    };
+
+    int width;
+    int height;
+    glm::vec3 origin; // Camera basis of the last rasterize, used for exact per-pixel depth
+    glm::vec3 forward;
+    glm::vec3 right;
+    glm::vec3 up;
+    float aspectRatio;
+    std::vector<VisibilitySample> samples;
+    std::vector<ScreenTriangle> triangles;
+    std::vector<std::vector<int>> tileBins;
+    std::vector<AABB> boxes;
+
+    void addFace(const PrimaryRays &rays, int object, int face);
+    void rasterizeTile(int tile);
+    float faceDepth(int object, int face, int x, int y) const;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <glm/glm.hpp>
+
+#include "bvh.h"
+#include "threadpool.h"
+
+#define REGRESSION_RUNS 3              // Each case is timed this many times and the fastest run is kept
+#define REGRESSION_MIN_PSNR 40.0       // Minimum PSNR (dB) against the golden image or the counterpart frame
+#define REGRESSION_TIME_TOLERANCE 1.25 // Allowed render time relative to the recorded baseline
+#define REGRESSION_PSNR_CAP 100.0      // Reported PSNR for identical images
+#define REGRESSION_NOT_RECORDED 2      // Exit status when goldens or baselines are missing rather than failing
+
+// One reference render: scene, camera pose, resolution and the trace settings it exercises
+struct RegressionCase
+{
+    std::string name;
+    std::string scene; // "demo" for the interactive scene, "glass" for the built-in glass stack
+    glm::vec3 position;
+    glm::vec3 target;
+    int width;
+    int height;
+    int samples;
+    int maxDepth;
+    bool rasterPrimary;
+    std::string counterpart; // Earlier case of the same pose this frame must match (traced vs raster), or empty
+};
+
+// Renders every reference case headlessly and checks it against directory/<case>.ppm (image
+// quality) and directory/baseline.txt (render time), writing the results to directory/report.json.
+// Cases with a counterpart are also compared with its frame, which needs no recorded data.
+// The demo cases render the given scene; the glass cases build their own. Times are only checked
+// when the baseline was recorded with the same render pool size; otherwise they are "not comparable".
+// With record set the goldens and the baseline are rewritten instead.
+// Returns the process exit status: 0 when every case passes, 1 when any case fails and
+// REGRESSION_NOT_RECORDED when the rest pass but some golden image or baseline was never recorded.
+int runRegression(const BVH &scene, ThreadPool &pool, const std::string &directory, bool record);
@@ -0,0 +1,72 @@
+#pragma once
+
+#define BIAS 0.01f
+#define MAX_RECURSION_DEPTH 2 // Default depth limit, overridable at runtime through traceSettings
+#define MAX_TRACE_DEPTH 64     // Largest depth limit accepted from the command line; keeps the recursion off the stack limit
+#define MIN_PATH_WEIGHT 0.01f // Default throughput below which secondary rays are culled
+
+#include <atomic>
+#include <glm/glm.hpp>
+
+#include "bvh.h"
+#include "camera.h"
+#include "color.h"
+#include "framebuffer.h"
+#include "light.h"
+#include "rasterizer.h"
+#include "skybox.h"
+#include "threadpool.h"
+
+// Limits for reflected and refracted rays. Every ray carries the product of the reflectivity and
+// transparency factors along its path (its weight); a secondary ray whose weight falls below
+// minWeight is dropped, or with russianRoulette kept with probability weight / minWeight and
+// scaled up accordingly. Radiance is accumulated in float down the recursion and only clamped to a
+// Color for the final pixel, so the roulette estimate stays unbiased.
+struct TraceSettings
+{
+    int maxDepth = MAX_RECURSION_DEPTH;
+    float minWeight = MIN_PATH_WEIGHT;
+    bool russianRoulette = false;
+    bool rasterPrimary = true; // Resolve primary visibility with the rasteriser instead of the BVH
+};
+
+// Scene lighting shared by the interactive window and the render server
+extern Light light;
+extern Skybox skybox;
+extern TraceSettings traceSettings;
+
+float castShadow(const glm::vec3 &shadowOrig, const glm::vec3 &lightDir, const BVH &scene, Object *hitObject);
+Color castRay(const glm::vec3 &orig, const glm::vec3 &dir, const BVH &scene, float deltaTime, const int recursion = 0, float weight = 1.0f);
+
+// Shades a known hit; castRay calls it after its BVH query, the visibility pass calls it directly
+Color shadeHit(const glm::vec3 &orig, const glm::vec3 &dir, const Intersect &intersect, Object *hitObject, const BVH &scene, float deltaTime, const int recursion, float weight);
+
+// Camera basis for generating primary rays of an image with the given resolution
+struct PrimaryRays
+{
+    glm::vec3 origin;
+    glm::vec3 forward;
+    glm::vec3 right;
+    glm::vec3 up;
+    int width;
+    int height;
+    float aspectRatio;
+
+    PrimaryRays(const Camera &view, int width, int height);
+
+    // Normalized direction through pixel coordinates (x, y)
+    glm::vec3 direction(float x, float y) const;
+};
+
+// Traces one row of the frame, averaging the given number of samples per pixel.
+// With a visibility buffer (single sample only) primary hits are taken from it instead of the BVH.
+void traceRow(const PrimaryRays &rays, const BVH &scene, float deltaTime, FrameBuffer &frame, int y, int samples = 1,
+              const VisibilityBuffer *visibility = nullptr);
+
+// Traces one frame from the given camera pose into the frame buffer using the render pool.
+// Full-resolution frames resolve primary visibility with the rasteriser when traceSettings allows it.
+// With step > 1 only one ray per step x step block is traced and the block is filled with it (preview).
+// If poseVersion is given, rows stop being traced as soon as it no longer matches tracedVersion
+// and the function returns false: the partial frame is stale and must not be presented.
+bool traceFrame(const Camera view, const BVH &scene, float deltaTime, FrameBuffer &frame, ThreadPool &pool,
+                int step = 1, const std::atomic<unsigned int> *poseVersion = nullptr, unsigned int tracedVersion = 0);
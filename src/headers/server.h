@@ -0,0 +1,85 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "bvh.h"
+#include "framebuffer.h"
+#include "threadpool.h"
+
+#define SERVER_MAX_RESOLUTION 4096
+#define SERVER_MAX_SAMPLES 64
+#define SERVER_MAX_VIEW_SLOPE 0.999f // Largest |forward.y|; steeper views leave the camera basis undefined
+#define SERVER_MAX_REQUEST_LENGTH 256 // Longest request line accepted; a valid RENDER line is far shorter
+
+// One render request: camera pose, output resolution and samples per pixel
+struct RenderRequest
+{
+    glm::vec3 position;
+    glm::vec3 target;
+    int width;
+    int height;
+    int samples;
+};
+
+// Parses "RENDER px py pz tx ty tz width height samples"; on failure returns false and sets error
+bool parseRenderRequest(const std::string &line, RenderRequest &request, std::string &error);
+
+// Headless render daemon. The scene and its BVH are built once by the caller; clients connect to a
+// Unix socket and send one request per line. Each reply is "OK <bytes>\n" followed by a PPM image,
+// or "ERR <message>\n". Requests from all clients that arrive while a batch is rendering are merged
+// into the next batch, whose rows are scheduled together on the shared pool.
+class RenderServer
+{
+public:
+    RenderServer(const BVH &scene, ThreadPool &pool, size_t maxBatchSize = 32);
+    ~RenderServer();
+
+    // Listens on socketPath and serves clients until the socket fails; returns the process exit status
+    int run(const std::string &socketPath);
+
+private:
+    struct Job
+    {
+        RenderRequest request;
+        FrameBuffer frame;
+        std::promise<void> done;
+
+        explicit Job(const RenderRequest &req) : request(req), frame(req.width, req.height) {}
+    };
+
+    // Connection handler; finished handlers are joined on the next accept, and all of them before run() returns
+    struct Client
+    {
+        std::thread thread;
+        int socket;
+        bool finished;
+    };
+
+    const BVH &scene;
+    ThreadPool &pool;
+    size_t maxBatchSize;
+
+    std::deque<std::shared_ptr<Job>> pending;
+    std::mutex pendingMutex;
+    std::condition_variable pendingCondition;
+    bool stopping;
+    std::thread scheduler;
+
+    std::list<Client> clients;
+    std::mutex clientsMutex;
+
+    void schedulerLoop();
+    void renderBatch(const std::vector<std::shared_ptr<Job>> &batch);
+    void handleClient(Client *client);
+    void reapFinishedClients();
+    void disconnectClients();
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads used by the renderer.
+// The thread count is chosen explicitly (0 means one per CPU the process may run on) and
+// each worker can optionally be pinned to a CPU. Pin targets come from the given core list,
+// or else from the process affinity mask, so the pool respects e.g. `taskset -c 4-7`.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int threadCount = 0, bool pinThreads = false, const std::vector<int> &cores = {});
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Queues a task and returns a future that becomes ready once it has run
+    std::future<void> submit(std::function<void()> task);
+
+    // Runs body(i) for every i in [begin, end) on the workers and blocks until all are done.
+    // Indices are handed out dynamically so uneven rows do not stall the whole range.
+    void parallelFor(int begin, int end, const std::function<void(int)> &body);
+
+    unsigned int size() const { return static_cast<unsigned int>(workers.size()); }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::packaged_task<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping;
+
+    void workerLoop();
+    static std::vector<int> allowedCores();
+    static void pinToCore(std::thread &thread, int core);
+};
@@ -1,7 +1,4 @@
 #define FOV glm::radians(90.0f)
-#define ASPECT_RATIO (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT
-#define BIAS 0.01f
-#define MAX_RECURSION_DEPTH 2
 
 #include <SDL2/SDL.h>
 #include <glm/glm.hpp>
@@ -10,164 +7,68 @@
 #include <vector>
 #include <cstdlib>
 #include <algorithm>
-#include <execution>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <numeric>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <string>
 
-#include "./headers/skybox.h"
-#include "./headers/light.h"
 #include "./headers/color.h"
 #include "./headers/object.h"
 #include "./headers/cube.h"
+#include "./headers/bvh.h"
 #include "./headers/camera.h"
+#include "./headers/framebuffer.h"
+#include "./headers/threadpool.h"
+#include "./headers/renderer.h"
+#include "./headers/server.h"
+#include "./headers/regression.h"
 
 #define SCREEN_WIDTH 800
 #define SCREEN_HEIGHT 600
+#define PREVIEW_STEP 8     // Block size of the low-resolution preview traced right after the camera moves
+#define INPUT_POLL_MS 5    // Upper bound on how long the main thread waits for events before checking for a finished frame
 
 SDL_Renderer *renderer = nullptr;
-Light light(glm::vec3(20.0f, 0.0f, 0.0f), 1.5f, Color(255, 255, 255));
 Camera camera(glm::vec3(-20.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f), 10.0f);
-Skybox skybox("./textures/sky.jpg");
+std::mutex cameraMutex;                    // Guards camera between the main thread (input) and the render thread
+std::atomic<unsigned int> cameraVersion(0); // Bumped on every camera change; in-flight frames of older versions are cancelled
 
-float castShadow(const glm::vec3 &shadowOrig, const glm::vec3 &lightDir, const std::vector<Object *> &objects, Object *hitObject)
+// Copies a finished frame into the streaming texture; the texture is created once and reused every frame
+void renderFromBuffer(SDL_Texture *texture, const FrameBuffer &frame)
 {
-    for (auto &obj : objects)
-    {
-        if (obj != hitObject)
-        {
-            Intersect shadowIntersect = obj->rayIntersect(shadowOrig, lightDir);
-            if (shadowIntersect.isIntersecting && shadowIntersect.distance > 0)
-            {
-                const float shadowIntensity = (1.0f - glm::min(1.0f, shadowIntersect.distance / glm::length(light.position - shadowOrig)));
-                return shadowIntensity;
-            }
-        }
-    }
-    return 1.0f;
-}
-
-Color castRay(const glm::vec3 &orig, const glm::vec3 &dir, const std::vector<Object *> &objects, float deltaTime, const short recursion = 0)
-{
-    Intersect intersect;
-    Object *hitObject = nullptr;
-    float zBuffer = std::numeric_limits<float>::infinity();
-
-    for (auto &obj : objects)
-    {
-        Intersect tempIntersect = obj->rayIntersect(orig, dir);
-        if (tempIntersect.isIntersecting && tempIntersect.distance < zBuffer)
-        {
-            zBuffer = tempIntersect.distance;
-            intersect = tempIntersect;
-            hitObject = obj;
-        }
-    }
-
-    if (!intersect.isIntersecting || recursion >= MAX_RECURSION_DEPTH)
-    {
-        return skybox.getColor(dir); // Sky color
-    }
-
-    const Material &hitMaterial = hitObject->getMaterial();
-    glm::vec3 lightDir = glm::normalize(light.position - intersect.point);
-    glm::vec3 viewDir = glm::normalize(orig - intersect.point);
-
-    float shadowIntensity = castShadow(intersect.point + BIAS * intersect.normal, lightDir, objects, hitObject);
-    float intensity = shadowIntensity * light.intensity;
-
-    float diffuseLightIntensity = std::max(0.0f, glm::dot(intersect.normal, lightDir));
-    glm::vec3 reflectDir = glm::reflect(-lightDir, intersect.normal);
-    float spec = std::pow(std::max(0.0f, glm::dot(viewDir, reflectDir)), hitMaterial.specularCoefficient);
-
-    // Usar el método GetDiffuse para manejar texturas animadas
-    Color diffuseLight = intensity * diffuseLightIntensity * hitMaterial.albedo * hitMaterial.GetDiffuse(deltaTime);
-    Color specularLight = intensity * spec * hitMaterial.specularAlbedo * light.color;
-
-    Color reflectedColor(0.0f, 0.0f, 0.0f);
-    if (hitMaterial.reflectivity > 0)
-    {
-        glm::vec3 offsetOrigin = intersect.point + intersect.normal * BIAS;
-        reflectedColor = hitMaterial.reflectivity * castRay(offsetOrigin, reflectDir, objects, deltaTime, recursion + 1);
-    }
-
-    Color refractedColor(0.0f, 0.0f, 0.0f);
-    if (hitMaterial.transparency > 0)
-    {
-        glm::vec3 refractDir = glm::refract(dir, intersect.normal, hitMaterial.refractionIndex);
-        glm::vec3 offsetOrigin = intersect.point - intersect.normal * BIAS;
-        refractedColor = hitMaterial.transparency * castRay(offsetOrigin, refractDir, objects, deltaTime, recursion + 1);
-    }
-
-    return (1 - hitMaterial.reflectivity - hitMaterial.transparency) * (diffuseLight + specularLight) + reflectedColor + refractedColor;
-}
-
-void pixel(glm::vec2 position, Color color)
-{
-    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-    SDL_RenderDrawPoint(renderer, position.x, position.y);
-}
-
-void renderFromBuffer(const std::array<std::array<Color, SCREEN_WIDTH>, SCREEN_HEIGHT> &pixels)
-{
-    int textureWidth = SCREEN_WIDTH;
-    int textureHeight = SCREEN_HEIGHT;
-
-    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, textureWidth, textureHeight);
-
     void *texturePixels;
     int pitch;
 
     SDL_LockTexture(texture, NULL, &texturePixels, &pitch);
 
-    Uint32 format = SDL_PIXELFORMAT_ARGB8888;
-    SDL_PixelFormat *mappingFormat = SDL_AllocFormat(format);
-
     Uint32 *texturePixels32 = static_cast<Uint32 *>(texturePixels);
-    for (int y = 0; y < textureHeight; y++)
+    for (int y = 0; y < frame.height; y++)
     {
-        for (int x = 0; x < textureWidth; x++)
+        Uint32 *row = texturePixels32 + y * (pitch / sizeof(Uint32));
+        for (int x = 0; x < frame.width; x++)
         {
-            int index = y * (pitch / sizeof(Uint32)) + x;
-            const Color &color = pixels[y][x];
-            texturePixels32[index] = SDL_MapRGBA(mappingFormat, color.r, color.g, color.b, color.a);
+            // Pack directly as ARGB8888, the texture's format
+            const Color &color = frame.at(x, y);
+            row[x] = (Uint32(color.a) << 24) | (Uint32(color.r) << 16) | (Uint32(color.g) << 8) | Uint32(color.b);
         }
     }
 
     SDL_UnlockTexture(texture);
-    SDL_Rect textureRect = {0, 0, textureWidth, textureHeight};
+    SDL_Rect textureRect = {0, 0, frame.width, frame.height};
     SDL_RenderCopy(renderer, texture, NULL, &textureRect);
-    SDL_DestroyTexture(texture);
-}
-
-void render(std::vector<Object *> &objects, float deltaTime)
-{
-    glm::vec3 simulatedUp = glm::vec3(0, 1, 0);
-    std::vector<int> rows(SCREEN_HEIGHT);
-    std::iota(rows.begin(), rows.end(), 0);
-    std::array<std::array<Color, SCREEN_WIDTH>, SCREEN_HEIGHT> pixels;
-
-    std::for_each(std::execution::par, rows.begin(), rows.end(), [&](int y)
-                  {
-        for (int x = 0; x < SCREEN_WIDTH; ++x) {
-            float screenX =  (2.0f * x) / SCREEN_WIDTH - 1.0f;
-            float screenY = -(2.0f * y) / SCREEN_HEIGHT + 1.0f;
-
-            screenX *= ASPECT_RATIO;
-
-            glm::vec3 dir = glm::normalize(camera.target - camera.position);
-            glm::vec3 right = glm::normalize(glm::cross(dir, simulatedUp));
-            glm::vec3 up = glm::cross(right, dir);
-
-            dir = dir + right * screenX + up * screenY;
-
-            Color pixelColor = castRay(camera.position, glm::normalize(dir), objects, deltaTime);
-
-            pixels[y][x] = pixelColor;
-        } });
-
-    renderFromBuffer(pixels);
 }
 
 void handleKeyPress(SDL_Keycode key)
 {
+    std::lock_guard<std::mutex> lock(cameraMutex);
+    glm::vec3 previousPosition = camera.position;
+
     switch (key)
     {
     case SDLK_UP:
@@ -191,6 +92,11 @@ void handleKeyPress(SDL_Keycode key)
     default:
         break;
     }
+
+    if (camera.position != previousPosition)
+    {
+        cameraVersion++;
+    }
 }
 
 void processKeyEvents(const SDL_Event &event, std::unordered_map<SDL_Keycode, bool> &keyStates)
@@ -224,26 +130,24 @@ std::vector<Color> loadWaterFrames()
     return frames;
 }
 
-int main(int argc, char *args[])
+// Parses a command-line number, throwing std::invalid_argument for trailing garbage, negative,
+// out-of-range or (for integer types) fractional values
+template <typename T>
+T parseNonNegative(const std::string &text)
 {
-    SDL_Init(SDL_INIT_VIDEO);
-
-    SDL_Window *window = SDL_CreateWindow(
-        "Ray Tracer",
-        SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-        SCREEN_WIDTH, SCREEN_HEIGHT,
-        SDL_WINDOW_OPENGL);
-
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-
-    bool isRunning = true;
-    SDL_Event event;
-    float rotateAngle = 0.0f;
-
-    unsigned int lastTime = SDL_GetTicks();
-    unsigned int currentTime;
-    float dT;
+    size_t parsed = 0;
+    double value = std::stod(text, &parsed);
+    bool fractional = std::is_integral<T>::value && value != std::floor(value);
+    if (parsed != text.size() || !(value >= 0.0) || fractional || value > static_cast<double>(std::numeric_limits<T>::max()))
+    {
+        throw std::invalid_argument(text);
+    }
+    return static_cast<T>(value);
+}
 
+// Builds the diorama; the caller owns the returned objects
+std::vector<Object *> createScene()
+{
     Material ivory(
         Color(100, 100, 80),
         0.6f,
@@ -380,39 +284,244 @@ int main(int argc, char *args[])
     objects.push_back(new Cube(glm::vec3(55, 1, 5), glm::vec3(4, 15, 4), wood));      // Another new tree trunk
     objects.push_back(new Cube(glm::vec3(55, 16, 5), glm::vec3(10, 10, 10), velvet)); // Another new tree canopy
 
+    // Floating platform bobbing above the river
+    Cube *platform = new Cube(glm::vec3(27, 6, 10), glm::vec3(6, 1, 6), gold);
+    platform->setMotion([](float time)
+                        { return glm::vec3(27, 6 + 3 * std::sin(time), 10); });
+    objects.push_back(platform);
+
+    return objects;
+}
+
+int main(int argc, char *args[])
+{
+    // Render pool configuration: --threads N (0 = every CPU the process may use), --pin to bind workers
+    // to those CPUs, and --cores LIST (e.g. 4,5,6,7) to pin them to an explicit set instead
+    unsigned int renderThreads = 0;
+    bool pinRenderThreads = false;
+    std::vector<int> renderCores;
+    std::string serverSocket; // --server PATH runs headless, serving render requests on a Unix socket
+    std::string regressionDirectory; // --regress DIR runs the golden-image and render-time checks
+    bool recordRegression = false;   // --record rewrites the goldens and baseline instead of checking them
+    const std::string usage = std::string("Usage: ") + args[0] + " [--threads N] [--pin] [--cores LIST] [--server SOCKET] [--max-depth N] [--min-weight W] [--roulette] [--no-raster] [--regress DIR [--record]]";
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = args[i];
+            if (arg == "--threads" && i + 1 < argc)
+            {
+                renderThreads = static_cast<unsigned int>(parseNonNegative<int>(args[++i]));
+            }
+            else if (arg == "--pin")
+            {
+                pinRenderThreads = true;
+            }
+            else if (arg == "--cores" && i + 1 < argc)
+            {
+                std::stringstream coreList(args[++i]);
+                std::string core;
+                while (std::getline(coreList, core, ','))
+                {
+                    renderCores.push_back(parseNonNegative<int>(core));
+                }
+                pinRenderThreads = true;
+            }
+            else if (arg == "--server" && i + 1 < argc)
+            {
+                serverSocket = args[++i];
+            }
+            else if (arg == "--max-depth" && i + 1 < argc)
+            {
+                traceSettings.maxDepth = parseNonNegative<int>(args[++i]);
+                if (traceSettings.maxDepth > MAX_TRACE_DEPTH)
+                {
+                    std::cerr << "--max-depth must be at most " << MAX_TRACE_DEPTH << std::endl;
+                    std::cerr << usage << std::endl;
+                    return 1;
+                }
+            }
+            else if (arg == "--min-weight" && i + 1 < argc)
+            {
+                traceSettings.minWeight = parseNonNegative<float>(args[++i]);
+            }
+            else if (arg == "--roulette")
+            {
+                traceSettings.russianRoulette = true;
+            }
+            else if (arg == "--no-raster")
+            {
+                traceSettings.rasterPrimary = false;
+            }
+            else if (arg == "--regress" && i + 1 < argc)
+            {
+                regressionDirectory = args[++i];
+            }
+            else if (arg == "--record")
+            {
+                recordRegression = true;
+            }
+            else
+            {
+                std::cerr << "Unknown argument: " << arg << std::endl;
+                std::cerr << usage << std::endl;
+                return 1;
+            }
+        }
+    }
+    catch (const std::exception &)
+    {
+        std::cerr << "Invalid value for argument" << std::endl;
+        std::cerr << usage << std::endl;
+        return 1;
+    }
+
+    ThreadPool pool(renderThreads, pinRenderThreads, renderCores);
+    std::cout << "Rendering with " << pool.size() << " threads" << (pinRenderThreads ? " (pinned)" : "") << std::endl;
+
+    std::vector<Object *> objects = createScene();
+    BVH scene;
+    scene.build(objects);
+
+    if (!serverSocket.empty() || !regressionDirectory.empty())
+    {
+        int status;
+        if (!regressionDirectory.empty())
+        {
+            status = runRegression(scene, pool, regressionDirectory, recordRegression);
+        }
+        else
+        {
+            RenderServer server(scene, pool);
+            status = server.run(serverSocket);
+        }
+        for (Object *object : objects)
+        {
+            delete object;
+        }
+        return status;
+    }
+
+    SDL_Init(SDL_INIT_VIDEO);
+
+    SDL_Window *window = SDL_CreateWindow(
+        "Ray Tracer",
+        SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+        SCREEN_WIDTH, SCREEN_HEIGHT,
+        SDL_WINDOW_OPENGL);
+
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    bool isRunning = true;
+    SDL_Event event;
+    float rotateAngle = 0.0f;
+
+    unsigned int lastTime = SDL_GetTicks();
+    unsigned int currentTime;
+    float dT = 0.0f;
+
     int frameCount = 0;
     float elapsedTime = 0.0f;
 
     std::unordered_map<SDL_Keycode, bool> keyStates;
 
+    // Frames flow render thread -> mailbox -> main thread. The main thread only handles input and
+    // presentation, so camera changes take effect without waiting for the frame being traced.
+    FrameBuffer renderBuffer(SCREEN_WIDTH, SCREEN_HEIGHT);
+    FrameBuffer mailbox(SCREEN_WIDTH, SCREEN_HEIGHT);
+    FrameBuffer presentBuffer(SCREEN_WIDTH, SCREEN_HEIGHT);
+    std::mutex mailboxMutex;
+    bool mailboxReady = false;
+    unsigned int mailboxVersion = 0;
+    std::atomic<bool> renderRunning(true);
+
+    std::thread renderThread([&]()
+                             {
+        unsigned int lastRenderTime = SDL_GetTicks();
+        unsigned int renderedVersion = cameraVersion.load() - 1; // Forces a preview for the first frame
+
+        while (renderRunning) {
+            unsigned int version;
+            Camera view = [&]() {
+                std::lock_guard<std::mutex> lock(cameraMutex);
+                version = cameraVersion.load();
+                return camera;
+            }();
+
+            unsigned int now = SDL_GetTicks();
+            float deltaTime = (now - lastRenderTime) / 1000.0f;
+            lastRenderTime = now;
+
+            // Animate dynamic objects between traces and refit only what moved
+            scene.animate(deltaTime);
+
+            // A new pose restarts from a cheap preview, then refines to full resolution
+            int step = (version != renderedVersion) ? PREVIEW_STEP : 1;
+            renderedVersion = version;
+            while (step > 0) {
+                if (!traceFrame(view, scene, deltaTime, renderBuffer, pool, step, &cameraVersion, version)) {
+                    break;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mailboxMutex);
+                    std::swap(renderBuffer, mailbox);
+                    mailboxVersion = version;
+                    mailboxReady = true;
+                }
+                step = (step == 1) ? 0 : 1;
+            }
+        } });
+
     while (isRunning)
     {
-        while (SDL_PollEvent(&event))
+        if (SDL_WaitEventTimeout(&event, INPUT_POLL_MS))
+        {
+            do
+            {
+                switch (event.type)
+                {
+                case SDL_QUIT:
+                    isRunning = false;
+                    break;
+                default:
+                    processKeyEvents(event, keyStates);
+                    break;
+                }
+            } while (SDL_PollEvent(&event));
+        }
+
+        // Present the newest finished frame unless the camera has moved since it was traced
+        bool hasNewFrame = false;
         {
-            switch (event.type)
+            std::lock_guard<std::mutex> lock(mailboxMutex);
+            if (mailboxReady)
             {
-            case SDL_QUIT:
-                isRunning = false;
-                break;
-            default:
-                processKeyEvents(event, keyStates);
-                break;
+                mailboxReady = false;
+                if (mailboxVersion == cameraVersion.load())
+                {
+                    std::swap(mailbox, presentBuffer);
+                    hasNewFrame = true;
+                }
             }
         }
 
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
+        if (hasNewFrame)
+        {
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+            SDL_RenderClear(renderer);
 
-        render(objects, dT);
+            renderFromBuffer(texture, presentBuffer);
 
-        SDL_RenderPresent(renderer);
+            SDL_RenderPresent(renderer);
+            frameCount++;
+        }
 
         // Calculate the deltaTime
         currentTime = SDL_GetTicks();
-        dT = (currentTime - lastTime) / 1000.0f; // Time since last frame in seconds
+        dT = (currentTime - lastTime) / 1000.0f; // Time since last loop iteration in seconds
         lastTime = currentTime;
 
-        frameCount++;
         elapsedTime += dT;
         if (elapsedTime >= 1.0f)
         {
@@ -424,12 +533,18 @@ int main(int argc, char *args[])
         }
     }
 
+    // Stop the render thread and cancel whatever frame it is tracing
+    renderRunning = false;
+    cameraVersion++;
+    renderThread.join();
+
     for (Object *object : objects)
     {
         delete object;
     }
     objects.clear();
 
+    SDL_DestroyTexture(texture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
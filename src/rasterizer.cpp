@@ -0,0 +1,277 @@
+#include "./headers/rasterizer.h"
+#include "./headers/renderer.h"
+
+#include <algorithm>
+#include <cmath>
+
+VisibilityBuffer::VisibilityBuffer(int width, int height)
+    : width(width), height(height), origin(0.0f), forward(0.0f, 0.0f, 1.0f), right(1.0f, 0.0f, 0.0f),
+      up(0.0f, 1.0f, 0.0f), aspectRatio((float)width / (float)height), samples(width * height)
+{
+    int tilesX = (width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    int tilesY = (height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    tileBins.resize(tilesX * tilesY);
+}
+
+bool VisibilityBuffer::rasterize(const PrimaryRays &rays, const BVH &scene, ThreadPool &pool)
+{
+    const std::vector<Object *> &objects = scene.getObjects();
+
+    origin = rays.origin;
+    forward = rays.forward;
+    right = rays.right;
+    up = rays.up;
+    aspectRatio = rays.aspectRatio;
+    triangles.clear();
+    boxes.clear();
+    boxes.reserve(objects.size());
+    for (std::vector<int> &bin : tileBins)
+    {
+        bin.clear();
+    }
+
+    for (Object *object : objects)
+    {
+        if (!object->isBox())
+        {
+            return false;
+        }
+        AABB box = object->getBounds();
+
+        // From inside a box every face is behind or around the camera; let the rays handle it
+        if (rays.origin.x >= box.min.x && rays.origin.y >= box.min.y && rays.origin.z >= box.min.z &&
+            rays.origin.x <= box.max.x && rays.origin.y <= box.max.y && rays.origin.z <= box.max.z)
+        {
+            return false;
+        }
+        boxes.push_back(box);
+    }
+
+    for (int object = 0; object < static_cast<int>(boxes.size()); ++object)
+    {
+        for (int face = 0; face < 6; ++face)
+        {
+            addFace(rays, object, face);
+        }
+    }
+
+    pool.parallelFor(0, static_cast<int>(tileBins.size()), [&](int tile)
+                     { rasterizeTile(tile); });
+    return true;
+}
+
+// Clips one box face against the near plane, projects it and bins its triangles into screen tiles
+void VisibilityBuffer::addFace(const PrimaryRays &rays, int object, int face)
+{
+    const AABB &box = boxes[object];
+    int axis = face / 2;
+    bool maxSide = face % 2 == 1;
+    float plane = maxSide ? box.max[axis] : box.min[axis];
+
+    // Back faces are hidden by the box itself
+    if (maxSide ? rays.origin[axis] <= plane : rays.origin[axis] >= plane)
+    {
+        return;
+    }
+
+    int u = (axis + 1) % 3;
+    int v = (axis + 2) % 3;
+    glm::vec3 corners[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        corners[i][axis] = plane;
+        corners[i][u] = (i == 1 || i == 2) ? box.max[u] : box.min[u];
+        corners[i][v] = (i >= 2) ? box.max[v] : box.min[v];
+    }
+
+    // View space: x along right, y along up, z along forward (depth)
+    glm::vec3 view[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        glm::vec3 relative = corners[i] - rays.origin;
+        view[i] = glm::vec3(glm::dot(relative, rays.right), glm::dot(relative, rays.up), glm::dot(relative, rays.forward));
+    }
+
+    // Sutherland-Hodgman against the near plane and a slightly enlarged view frustum. Clipping the
+    // sides too keeps projected vertices close to the screen, where the edge functions stay precise.
+    float guardX = rays.aspectRatio * RASTER_GUARD_BAND;
+    float guardY = RASTER_GUARD_BAND;
+    auto planeDistance = [&](int plane, const glm::vec3 &point)
+    {
+        switch (plane)
+        {
+        case 0:
+            return point.z - RASTER_NEAR_PLANE;
+        case 1:
+            return guardX * point.z + point.x;
+        case 2:
+            return guardX * point.z - point.x;
+        case 3:
+            return guardY * point.z + point.y;
+        default:
+            return guardY * point.z - point.y;
+        }
+    };
+
+    glm::vec3 clipped[9];
+    glm::vec3 input[9];
+    int clippedCount = 4;
+    std::copy(view, view + 4, clipped);
+    for (int plane = 0; plane < 5 && clippedCount >= 3; ++plane)
+    {
+        int inputCount = clippedCount;
+        std::copy(clipped, clipped + inputCount, input);
+        clippedCount = 0;
+        for (int i = 0; i < inputCount; ++i)
+        {
+            const glm::vec3 &current = input[i];
+            const glm::vec3 &next = input[(i + 1) % inputCount];
+            float currentDistance = planeDistance(plane, current);
+            float nextDistance = planeDistance(plane, next);
+            if (currentDistance >= 0.0f)
+            {
+                clipped[clippedCount++] = current;
+            }
+            if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+            {
+                float t = currentDistance / (currentDistance - nextDistance);
+                clipped[clippedCount++] = glm::mix(current, next, t);
+            }
+        }
+    }
+    if (clippedCount < 3)
+    {
+        return;
+    }
+
+    // Inverse of PrimaryRays::direction: pixel coordinates of a view-space point
+    glm::vec2 projected[9];
+    for (int i = 0; i < clippedCount; ++i)
+    {
+        float screenX = clipped[i].x / clipped[i].z / rays.aspectRatio;
+        float screenY = clipped[i].y / clipped[i].z;
+        projected[i] = glm::vec2((screenX + 1.0f) * width * 0.5f, (1.0f - screenY) * height * 0.5f);
+    }
+
+    int tilesX = (width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    int tilesY = (height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    for (int i = 1; i + 1 < clippedCount; ++i)
+    {
+        ScreenTriangle triangle{{projected[0], projected[i], projected[i + 1]}, object, face};
+
+        // Bounds include the coverage tolerance so pixels just outside an edge reach the right tiles
+        float minX = std::min({triangle.vertices[0].x, triangle.vertices[1].x, triangle.vertices[2].x}) - RASTER_EDGE_TOLERANCE;
+        float maxX = std::max({triangle.vertices[0].x, triangle.vertices[1].x, triangle.vertices[2].x}) + RASTER_EDGE_TOLERANCE;
+        float minY = std::min({triangle.vertices[0].y, triangle.vertices[1].y, triangle.vertices[2].y}) - RASTER_EDGE_TOLERANCE;
+        float maxY = std::max({triangle.vertices[0].y, triangle.vertices[1].y, triangle.vertices[2].y}) + RASTER_EDGE_TOLERANCE;
+        if (maxX < 0.0f || maxY < 0.0f || minX > width - 1 || minY > height - 1)
+        {
+            continue;
+        }
+
+        int index = static_cast<int>(triangles.size());
+        triangles.push_back(triangle);
+
+        int firstTileX = std::max(0, static_cast<int>(minX) / RASTER_TILE_SIZE);
+        int lastTileX = std::min(tilesX - 1, static_cast<int>(maxX) / RASTER_TILE_SIZE);
+        int firstTileY = std::max(0, static_cast<int>(minY) / RASTER_TILE_SIZE);
+        int lastTileY = std::min(tilesY - 1, static_cast<int>(maxY) / RASTER_TILE_SIZE);
+        for (int tileY = firstTileY; tileY <= lastTileY; ++tileY)
+        {
+            for (int tileX = firstTileX; tileX <= lastTileX; ++tileX)
+            {
+                tileBins[tileY * tilesX + tileX].push_back(index);
+            }
+        }
+    }
+}
+
+static float edge(const glm::vec2 &a, const glm::vec2 &b, float x, float y)
+{
+    return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+}
+
+// View-space depth of the face plane along the primary ray of pixel (x, y). Computed from the plane
+// itself rather than interpolated, so coplanar faces of different boxes get exactly the same depth.
+float VisibilityBuffer::faceDepth(int object, int face, int x, int y) const
+{
+    const AABB &box = boxes[object];
+    int axis = face / 2;
+    float plane = face % 2 == 1 ? box.max[axis] : box.min[axis];
+
+    float screenX = ((2.0f * x) / width - 1.0f) * aspectRatio;
+    float screenY = -(2.0f * y) / height + 1.0f;
+    float slope = forward[axis] + right[axis] * screenX + up[axis] * screenY;
+    return (plane - origin[axis]) / slope;
+}
+
+// Draws the binned triangles of one tile. Pixels are sampled at integer coordinates, matching the
+// primary rays. Coverage is slightly conservative so shared edges never leave gaps and pixels exactly on
+// a box edge are not lost to rounding; the depth test resolves overlaps and traceRow re-tests the box.
+// Equal depths go to the lower object index, the same order the BVH uses for ties, so the result
+// does not depend on which triangle happens to be drawn first.
+void VisibilityBuffer::rasterizeTile(int tile)
+{
+    int tilesX = (width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    int startX = (tile % tilesX) * RASTER_TILE_SIZE;
+    int startY = (tile / tilesX) * RASTER_TILE_SIZE;
+    int endX = std::min(width, startX + RASTER_TILE_SIZE);
+    int endY = std::min(height, startY + RASTER_TILE_SIZE);
+
+    for (int y = startY; y < endY; ++y)
+    {
+        for (int x = startX; x < endX; ++x)
+        {
+            samples[y * width + x] = VisibilitySample{-1, -1, 0.0f};
+        }
+    }
+
+    for (int index : tileBins[tile])
+    {
+        const ScreenTriangle &triangle = triangles[index];
+        const glm::vec2 &v0 = triangle.vertices[0];
+        const glm::vec2 &v1 = triangle.vertices[1];
+        const glm::vec2 &v2 = triangle.vertices[2];
+
+        float area = edge(v0, v1, v2.x, v2.y);
+        if (std::abs(area) < 1e-8f)
+        {
+            continue;
+        }
+        // Edge functions are oriented positive inside; each tolerance is the edge length times the pixel margin
+        float orientation = area > 0.0f ? 1.0f : -1.0f;
+        float tolerance0 = -RASTER_EDGE_TOLERANCE * glm::length(v2 - v1);
+        float tolerance1 = -RASTER_EDGE_TOLERANCE * glm::length(v0 - v2);
+        float tolerance2 = -RASTER_EDGE_TOLERANCE * glm::length(v1 - v0);
+
+        int minX = std::max(startX, static_cast<int>(std::ceil(std::min({v0.x, v1.x, v2.x}) - RASTER_EDGE_TOLERANCE)));
+        int maxX = std::min(endX - 1, static_cast<int>(std::floor(std::max({v0.x, v1.x, v2.x}) + RASTER_EDGE_TOLERANCE)));
+        int minY = std::max(startY, static_cast<int>(std::ceil(std::min({v0.y, v1.y, v2.y}) - RASTER_EDGE_TOLERANCE)));
+        int maxY = std::min(endY - 1, static_cast<int>(std::floor(std::max({v0.y, v1.y, v2.y}) + RASTER_EDGE_TOLERANCE)));
+
+        for (int y = minY; y <= maxY; ++y)
+        {
+            for (int x = minX; x <= maxX; ++x)
+            {
+                if (edge(v1, v2, x, y) * orientation < tolerance0 || edge(v2, v0, x, y) * orientation < tolerance1 ||
+                    edge(v0, v1, x, y) * orientation < tolerance2)
+                {
+                    continue;
+                }
+
+                float depth = faceDepth(triangle.object, triangle.face, x, y);
+                if (!(depth > 0.0f))
+                {
+                    continue;
+                }
+                float inverseDepth = 1.0f / depth;
+                VisibilitySample &sample = samples[y * width + x];
+                if (inverseDepth > sample.inverseDepth ||
+                    (inverseDepth == sample.inverseDepth && triangle.object < sample.object))
+                {
+                    sample = VisibilitySample{triangle.object, triangle.face, inverseDepth};
+                }
+            }
+        }
+    }
+}
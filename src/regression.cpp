@@ -0,0 +1,303 @@
+#include "./headers/regression.h"
+#include "./headers/camera.h"
+#include "./headers/cube.h"
+#include "./headers/framebuffer.h"
+#include "./headers/renderer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+static const std::vector<RegressionCase> referenceCases = {
+    {"front", "demo", glm::vec3(-20, 0, 0), glm::vec3(0, 0, 0), 400, 300, 1, MAX_RECURSION_DEPTH, true, ""},
+    {"front_traced", "demo", glm::vec3(-20, 0, 0), glm::vec3(0, 0, 0), 400, 300, 1, MAX_RECURSION_DEPTH, false, "front"},
+    {"canopy_overhead", "demo", glm::vec3(10, 30, -10), glm::vec3(15, 0, 15), 400, 300, 1, MAX_RECURSION_DEPTH, true, ""},
+    {"river_deep", "demo", glm::vec3(40, 5, 40), glm::vec3(10, 3, 5), 400, 300, 1, 5, true, ""},
+    {"thumbnail", "demo", glm::vec3(-10, 15, -20), glm::vec3(25, 5, 15), 160, 120, 4, MAX_RECURSION_DEPTH, true, ""},
+    {"glass_deep", "glass", glm::vec3(-8, 5, -12), glm::vec3(5, 2, 2), 320, 240, 1, 8, true, ""},
+    {"glass_deep_traced", "glass", glm::vec3(-8, 5, -12), glm::vec3(5, 2, 2), 320, 240, 1, 8, false, "glass_deep"},
+};
+
+// Small scene of its own, so the deep-recursion cases do not move with edits to the demo scene:
+// a row of glass panes in front of a matte block, between two facing mirrors
+static std::vector<Object *> createGlassScene()
+{
+    Material floor(Color(120, 120, 120), 0.8f, 0.1f, 10.0f, 0.0f);
+    Material matte(Color(200, 40, 40), 0.9f, 0.2f, 10.0f, 0.0f);
+    Material mirror(Color(230, 230, 230), 0.2f, 0.9f, 200.0f, 0.9f);
+    Material glass(Color(255, 255, 255), 0.1f, 1.0f, 125.0f, 0.1f, 0.9f, 1.5f);
+
+    std::vector<Object *> objects;
+    objects.push_back(new Cube(glm::vec3(-10, -1, -10), glm::vec3(25, 1, 20), floor));
+    objects.push_back(new Cube(glm::vec3(3, 0, 6), glm::vec3(4, 4, 2), matte));
+    for (int pane = 0; pane < 4; ++pane)
+    {
+        objects.push_back(new Cube(glm::vec3(1, 0, 4 - 1.5f * pane), glm::vec3(8, 5, 0.5f), glass));
+    }
+    objects.push_back(new Cube(glm::vec3(-2, 0, -4), glm::vec3(0.5f, 6, 12), mirror));
+    objects.push_back(new Cube(glm::vec3(11, 0, -4), glm::vec3(0.5f, 6, 12), mirror));
+    return objects;
+}
+
+// Renders one case with its own trace settings; the global settings are restored afterwards
+static FrameBuffer renderCase(const RegressionCase &test, const BVH &scene, ThreadPool &pool)
+{
+    TraceSettings previous = traceSettings;
+    traceSettings = TraceSettings();
+    traceSettings.maxDepth = test.maxDepth;
+    traceSettings.rasterPrimary = test.rasterPrimary;
+
+    Camera view(test.position, test.target, 0.0f);
+    FrameBuffer frame(test.width, test.height);
+    if (test.samples <= 1)
+    {
+        traceFrame(view, scene, 0.0f, frame, pool);
+    }
+    else
+    {
+        PrimaryRays rays(view, test.width, test.height);
+        pool.parallelFor(0, test.height, [&](int y)
+                         { traceRow(rays, scene, 0.0f, frame, y, test.samples); });
+    }
+
+    traceSettings = previous;
+    return frame;
+}
+
+static bool writeFile(const std::string &path, const std::string &data)
+{
+    std::ofstream file(path, std::ios::binary);
+    file << data;
+    return static_cast<bool>(file);
+}
+
+// Reads a binary PPM (P6, maxval 255) as written by FrameBuffer::toPPM
+static bool loadPPM(const std::string &path, std::vector<Color> &pixels, int &width, int &height)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::string magic;
+    int maxValue;
+    if (!(file >> magic >> width >> height >> maxValue) || magic != "P6" || maxValue != 255 || width < 1 || height < 1)
+    {
+        return false;
+    }
+    file.get();
+
+    std::vector<char> data(static_cast<size_t>(width) * height * 3);
+    if (!file.read(data.data(), data.size()))
+    {
+        return false;
+    }
+    pixels.resize(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < pixels.size(); ++i)
+    {
+        pixels[i] = Color(Uint8(data[3 * i]), Uint8(data[3 * i + 1]), Uint8(data[3 * i + 2]));
+    }
+    return true;
+}
+
+// Peak signal-to-noise ratio over the RGB channels, capped for identical images
+static double psnr(const FrameBuffer &frame, const std::vector<Color> &golden)
+{
+    double squaredError = 0.0;
+    for (size_t i = 0; i < golden.size(); ++i)
+    {
+        const Color &a = frame.pixels[i];
+        const Color &b = golden[i];
+        double dr = double(a.r) - b.r, dg = double(a.g) - b.g, db = double(a.b) - b.b;
+        squaredError += dr * dr + dg * dg + db * db;
+    }
+    double meanSquaredError = squaredError / (golden.size() * 3.0);
+    if (meanSquaredError == 0.0)
+    {
+        return REGRESSION_PSNR_CAP;
+    }
+    return std::min(REGRESSION_PSNR_CAP, 10.0 * std::log10(255.0 * 255.0 / meanSquaredError));
+}
+
+int runRegression(const BVH &demoScene, ThreadPool &pool, const std::string &directory, bool record)
+{
+    const std::string baselinePath = directory + "/baseline.txt";
+
+    // ctest runs the gate directly, so the directory may not exist yet on a fresh checkout
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    // baseline.txt holds "threads <pool size>" followed by "<case> <milliseconds>" lines
+    std::map<std::string, double> baseline;
+    unsigned int baselineThreads = 0; // 0 when the baseline predates the thread count
+    {
+        std::ifstream file(baselinePath);
+        std::string name;
+        double value;
+        while (file >> name >> value)
+        {
+            if (name == "threads")
+            {
+                baselineThreads = static_cast<unsigned int>(value);
+            }
+            else
+            {
+                baseline[name] = value;
+            }
+        }
+    }
+    // Times recorded with another pool size say nothing about this run
+    bool timesComparable = baselineThreads == pool.size();
+
+    std::vector<Object *> glassObjects = createGlassScene();
+    std::vector<std::unique_ptr<Object>> glassOwner(glassObjects.begin(), glassObjects.end());
+    BVH glassScene;
+    glassScene.build(glassObjects);
+
+    std::ostringstream report;
+    std::ostringstream newBaseline;
+    newBaseline << "threads " << pool.size() << "\n";
+    std::map<std::string, FrameBuffer> frames; // Kept for the cases that name them as counterpart
+    bool allPassed = true;
+    int notRecorded = 0;
+    report << "{\n  \"cases\": [";
+
+    for (size_t c = 0; c < referenceCases.size(); ++c)
+    {
+        const RegressionCase &test = referenceCases[c];
+        const BVH &scene = test.scene == "glass" ? glassScene : demoScene;
+
+        // Warm-up render, then keep the fastest timed run
+        FrameBuffer frame = renderCase(test, scene, pool);
+        double milliseconds = std::numeric_limits<double>::infinity();
+        for (int run = 0; run < REGRESSION_RUNS; ++run)
+        {
+            auto start = std::chrono::steady_clock::now();
+            frame = renderCase(test, scene, pool);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            milliseconds = std::min(milliseconds, elapsed.count());
+        }
+
+        // Traced and raster renders of one pose must agree; this check works before anything is recorded
+        bool hasCounterpart = !test.counterpart.empty();
+        double counterpartQuality = hasCounterpart ? psnr(frame, frames.at(test.counterpart).pixels) : 0.0;
+        bool counterpartPassed = !hasCounterpart || counterpartQuality >= REGRESSION_MIN_PSNR;
+        frames.emplace(test.name, frame);
+
+        const std::string goldenPath = directory + "/" + test.name + ".ppm";
+        if (record)
+        {
+            if (!counterpartPassed)
+            {
+                std::cerr << test.name << ": psnr=" << counterpartQuality << " dB against " << test.counterpart
+                          << ", not recording a frame that disagrees with its counterpart" << std::endl;
+                return 1;
+            }
+            if (!writeFile(goldenPath, frame.toPPM()))
+            {
+                std::cerr << "Failed to write " << goldenPath << std::endl;
+                return 1;
+            }
+            newBaseline << test.name << " " << milliseconds << "\n";
+            std::cout << test.name << ": recorded (" << milliseconds << " ms)" << std::endl;
+            continue;
+        }
+
+        // A golden or baseline that was never recorded is reported apart from a real failure
+        bool goldenRecorded = std::filesystem::exists(goldenPath);
+        auto budget = baseline.find(test.name);
+        bool hasBudget = budget != baseline.end();
+        std::string counterpartResult = hasCounterpart ? ", " + test.counterpart + " psnr=" + std::to_string(counterpartQuality) + " dB" : "";
+        std::ostringstream counterpartReport;
+        if (hasCounterpart)
+        {
+            counterpartReport << ", \"counterpart\": \"" << test.counterpart << "\", \"counterpartPsnr\": " << counterpartQuality
+                              << ", \"counterpartPassed\": " << (counterpartPassed ? "true" : "false");
+        }
+        if (!goldenRecorded || !hasBudget)
+        {
+            // Nothing to compare against, but a disagreeing counterpart is still a failure
+            notRecorded += counterpartPassed ? 1 : 0;
+            allPassed = allPassed && counterpartPassed;
+            std::cout << test.name << ": " << (counterpartPassed ? "NOT RECORDED" : "FAIL") << " ("
+                      << (goldenRecorded ? "" : "no golden image") << (goldenRecorded || hasBudget ? "" : ", ")
+                      << (hasBudget ? "" : "no baseline") << "), " << milliseconds << " ms" << counterpartResult << std::endl;
+            report << (c == 0 ? "\n" : ",\n")
+                   << "    {\"name\": \"" << test.name << "\", \"status\": \"" << (counterpartPassed ? "not recorded" : "fail") << "\""
+                   << counterpartReport.str()
+                   << ", \"goldenRecorded\": " << (goldenRecorded ? "true" : "false")
+                   << ", \"baselineRecorded\": " << (hasBudget ? "true" : "false")
+                   << ", \"milliseconds\": " << milliseconds << "}";
+            continue;
+        }
+
+        // A golden that exists but cannot be read or has the wrong size is a failure, not a missing recording
+        std::vector<Color> golden;
+        int goldenWidth = 0, goldenHeight = 0;
+        bool hasGolden = loadPPM(goldenPath, golden, goldenWidth, goldenHeight) && goldenWidth == test.width && goldenHeight == test.height;
+        double quality = hasGolden ? psnr(frame, golden) : 0.0;
+        bool imagePassed = hasGolden && quality >= REGRESSION_MIN_PSNR;
+        bool timePassed = !timesComparable || milliseconds <= budget->second * REGRESSION_TIME_TOLERANCE;
+        const char *timeStatus = !timesComparable ? "not comparable" : timePassed ? "pass" : "fail";
+
+        bool passed = imagePassed && timePassed && counterpartPassed;
+        allPassed = allPassed && passed;
+        std::cout << test.name << ": " << (passed ? "PASS" : "FAIL")
+                  << " psnr=" << quality << " dB, " << milliseconds << " ms"
+                  << " (baseline " << budget->second << " ms"
+                  << (timesComparable ? "" : " at " + std::to_string(baselineThreads) + " threads, time not comparable with " +
+                                                 std::to_string(pool.size())) << ")"
+                  << counterpartResult << (hasGolden ? "" : " (unreadable golden image)") << std::endl;
+
+        report << (c == 0 ? "\n" : ",\n")
+               << "    {\"name\": \"" << test.name << "\", \"status\": \"" << (passed ? "pass" : "fail")
+               << "\"" << counterpartReport.str() << ", \"psnr\": " << quality
+               << ", \"imagePassed\": " << (imagePassed ? "true" : "false")
+               << ", \"milliseconds\": " << milliseconds
+               << ", \"baselineMilliseconds\": " << budget->second
+               << ", \"timeStatus\": \"" << timeStatus << "\"}";
+    }
+
+    if (record)
+    {
+        if (!writeFile(baselinePath, newBaseline.str()))
+        {
+            std::cerr << "Failed to write " << baselinePath << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    report << "\n  ],\n  \"minPsnr\": " << REGRESSION_MIN_PSNR
+           << ",\n  \"timeTolerance\": " << REGRESSION_TIME_TOLERANCE
+           << ",\n  \"threads\": " << pool.size()
+           << ",\n  \"baselineThreads\": " << baselineThreads
+           << ",\n  \"notRecorded\": " << notRecorded
+           << ",\n  \"passed\": " << (allPassed && notRecorded == 0 ? "true" : "false") << "\n}\n";
+    if (!writeFile(directory + "/report.json", report.str()))
+    {
+        std::cerr << "Failed to write " << directory << "/report.json" << std::endl;
+        return 1;
+    }
+
+    if (!timesComparable && !baseline.empty())
+    {
+        std::cerr << "Render times were not checked: the baseline was recorded with " << baselineThreads
+                  << " threads and this run uses " << pool.size() << "." << std::endl;
+    }
+    if (!allPassed)
+    {
+        return 1;
+    }
+    if (notRecorded > 0)
+    {
+        std::cerr << notRecorded << " case(s) have no recorded golden image or baseline in " << directory
+                  << ". Run ./regress.sh --record on the reference machine and commit the result." << std::endl;
+        return REGRESSION_NOT_RECORDED;
+    }
+    return 0;
+}
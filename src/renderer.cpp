@@ -0,0 +1,256 @@
+#include "./headers/renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+Light light(glm::vec3(20.0f, 0.0f, 0.0f), 1.5f, Color(255, 255, 255));
+Skybox skybox("./textures/sky.jpg");
+TraceSettings traceSettings;
+
+// Decides whether a secondary ray with the given weight is traced; scale receives the factor
+// that compensates for rays culled by Russian roulette
+static bool continuePath(float weight, float &scale)
+{
+    scale = 1.0f;
+    // A weight that has underflowed to zero contributes nothing, even with --min-weight 0
+    if (weight > 0.0f && weight >= traceSettings.minWeight)
+    {
+        return true;
+    }
+    if (!traceSettings.russianRoulette || weight <= 0.0f)
+    {
+        return false;
+    }
+
+    thread_local std::minstd_rand generator(std::random_device{}());
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    float survival = weight / traceSettings.minWeight;
+    if (uniform(generator) >= survival)
+    {
+        return false;
+    }
+    scale = 1.0f / survival;
+    return true;
+}
+
+float castShadow(const glm::vec3 &shadowOrig, const glm::vec3 &lightDir, const BVH &scene, Object *hitObject)
+{
+    Intersect shadowIntersect;
+    if (scene.intersectFirst(shadowOrig, lightDir, shadowIntersect, hitObject, 0.0f))
+    {
+        const float shadowIntensity = (1.0f - glm::min(1.0f, shadowIntersect.distance / glm::length(light.position - shadowOrig)));
+        return shadowIntensity;
+    }
+    return 1.0f;
+}
+
+static glm::vec3 toRadiance(const Color &color)
+{
+    return glm::vec3(color.r, color.g, color.b);
+}
+
+static Color toColor(const glm::vec3 &radiance)
+{
+    return Color(
+        static_cast<Uint8>(glm::clamp(radiance.x, 0.0f, 255.0f)),
+        static_cast<Uint8>(glm::clamp(radiance.y, 0.0f, 255.0f)),
+        static_cast<Uint8>(glm::clamp(radiance.z, 0.0f, 255.0f)));
+}
+
+static glm::vec3 shadeRadiance(const glm::vec3 &orig, const glm::vec3 &dir, const Intersect &intersect, Object *hitObject, const BVH &scene, float deltaTime, const int recursion, float weight);
+
+// Radiance along a ray in 0-255 units. The recursion stays in float and is only clamped to a Color
+// at the top, so the Russian roulette compensation (a factor above 1) is not lost to saturation.
+static glm::vec3 traceRadiance(const glm::vec3 &orig, const glm::vec3 &dir, const BVH &scene, float deltaTime, const int recursion, float weight)
+{
+    Intersect intersect;
+    Object *hitObject = scene.intersect(orig, dir, intersect);
+
+    if (!intersect.isIntersecting || recursion >= traceSettings.maxDepth)
+    {
+        return toRadiance(skybox.getColor(dir)); // Sky color
+    }
+
+    return shadeRadiance(orig, dir, intersect, hitObject, scene, deltaTime, recursion, weight);
+}
+
+static glm::vec3 shadeRadiance(const glm::vec3 &orig, const glm::vec3 &dir, const Intersect &intersect, Object *hitObject, const BVH &scene, float deltaTime, const int recursion, float weight)
+{
+    const Material &hitMaterial = hitObject->getMaterial();
+    glm::vec3 lightDir = glm::normalize(light.position - intersect.point);
+    glm::vec3 viewDir = glm::normalize(orig - intersect.point);
+
+    float shadowIntensity = castShadow(intersect.point + BIAS * intersect.normal, lightDir, scene, hitObject);
+    float intensity = shadowIntensity * light.intensity;
+
+    float diffuseLightIntensity = std::max(0.0f, glm::dot(intersect.normal, lightDir));
+    glm::vec3 reflectDir = glm::reflect(-lightDir, intersect.normal);
+    float spec = std::pow(std::max(0.0f, glm::dot(viewDir, reflectDir)), hitMaterial.specularCoefficient);
+
+    // Usar el método GetDiffuse para manejar texturas animadas
+    Color diffuseLight = intensity * diffuseLightIntensity * hitMaterial.albedo * hitMaterial.GetDiffuse(deltaTime);
+    Color specularLight = intensity * spec * hitMaterial.specularAlbedo * light.color;
+
+    // The local term keeps its per-surface saturation; materials whose reflectivity and transparency
+    // add up to more than 1 contribute no local light, as with the clamped Color arithmetic
+    float localFactor = std::max(0.0f, 1 - hitMaterial.reflectivity - hitMaterial.transparency);
+    glm::vec3 radiance = localFactor * toRadiance(diffuseLight + specularLight);
+
+    float scale;
+
+    float reflectedWeight = weight * hitMaterial.reflectivity;
+    if (hitMaterial.reflectivity > 0 && continuePath(reflectedWeight, scale))
+    {
+        glm::vec3 offsetOrigin = intersect.point + intersect.normal * BIAS;
+        radiance += (hitMaterial.reflectivity * scale) * traceRadiance(offsetOrigin, reflectDir, scene, deltaTime, recursion + 1, reflectedWeight);
+    }
+
+    float refractedWeight = weight * hitMaterial.transparency;
+    if (hitMaterial.transparency > 0 && continuePath(refractedWeight, scale))
+    {
+        glm::vec3 refractDir = glm::refract(dir, intersect.normal, hitMaterial.refractionIndex);
+        glm::vec3 offsetOrigin = intersect.point - intersect.normal * BIAS;
+        radiance += (hitMaterial.transparency * scale) * traceRadiance(offsetOrigin, refractDir, scene, deltaTime, recursion + 1, refractedWeight);
+    }
+
+    return radiance;
+}
+
+Color castRay(const glm::vec3 &orig, const glm::vec3 &dir, const BVH &scene, float deltaTime, const int recursion, float weight)
+{
+    return toColor(traceRadiance(orig, dir, scene, deltaTime, recursion, weight));
+}
+
+Color shadeHit(const glm::vec3 &orig, const glm::vec3 &dir, const Intersect &intersect, Object *hitObject, const BVH &scene, float deltaTime, const int recursion, float weight)
+{
+    return toColor(shadeRadiance(orig, dir, intersect, hitObject, scene, deltaTime, recursion, weight));
+}
+
+PrimaryRays::PrimaryRays(const Camera &view, int width, int height)
+    : origin(view.position), width(width), height(height)
+{
+    glm::vec3 simulatedUp = glm::vec3(0, 1, 0);
+    forward = glm::normalize(view.target - view.position);
+    right = glm::normalize(glm::cross(forward, simulatedUp));
+    up = glm::cross(right, forward);
+    aspectRatio = (float)width / (float)height;
+}
+
+glm::vec3 PrimaryRays::direction(float x, float y) const
+{
+    float screenX = (2.0f * x) / width - 1.0f;
+    float screenY = -(2.0f * y) / height + 1.0f;
+
+    screenX *= aspectRatio;
+
+    return glm::normalize(forward + right * screenX + up * screenY);
+}
+
+void traceRow(const PrimaryRays &rays, const BVH &scene, float deltaTime, FrameBuffer &frame, int y, int samples,
+              const VisibilityBuffer *visibility)
+{
+    if (samples <= 1 && visibility)
+    {
+        const std::vector<Object *> &objects = scene.getObjects();
+        for (int x = 0; x < frame.width; ++x)
+        {
+            glm::vec3 dir = rays.direction(x, y);
+            const VisibilitySample &sample = visibility->at(x, y);
+            if (sample.object < 0)
+            {
+                frame.at(x, y) = skybox.getColor(dir);
+                continue;
+            }
+
+            // Only the visible box is tested, not the BVH. Its own slab test decides pixels exactly on a
+            // box edge, which the rasteriser covers inclusively, so the result matches a traced frame.
+            Intersect intersect = objects[sample.object]->rayIntersect(rays.origin, dir);
+            if (intersect.isIntersecting && intersect.distance > 0)
+            {
+                frame.at(x, y) = shadeHit(rays.origin, dir, intersect, objects[sample.object], scene, deltaTime, 0, 1.0f);
+            }
+            else
+            {
+                frame.at(x, y) = castRay(rays.origin, dir, scene, deltaTime);
+            }
+        }
+        return;
+    }
+
+    if (samples <= 1)
+    {
+        for (int x = 0; x < frame.width; ++x)
+        {
+            frame.at(x, y) = castRay(rays.origin, rays.direction(x, y), scene, deltaTime);
+        }
+        return;
+    }
+
+    // Supersampling: samples are spread over the pixel with a stratified x and golden-ratio y offset
+    for (int x = 0; x < frame.width; ++x)
+    {
+        float r = 0.0f, g = 0.0f, b = 0.0f;
+        for (int s = 0; s < samples; ++s)
+        {
+            float offsetX = (s + 0.5f) / samples;
+            float offsetY = std::fmod(0.5f + s * 0.618034f, 1.0f);
+            Color sample = castRay(rays.origin, rays.direction(x + offsetX, y + offsetY), scene, deltaTime);
+            r += sample.r;
+            g += sample.g;
+            b += sample.b;
+        }
+        frame.at(x, y) = Color(Uint8(r / samples), Uint8(g / samples), Uint8(b / samples));
+    }
+}
+
+bool traceFrame(const Camera view, const BVH &scene, float deltaTime, FrameBuffer &frame, ThreadPool &pool,
+                int step, const std::atomic<unsigned int> *poseVersion, unsigned int tracedVersion)
+{
+    PrimaryRays rays(view, frame.width, frame.height);
+
+    auto cancelled = [&]()
+    { return poseVersion && poseVersion->load(std::memory_order_relaxed) != tracedVersion; };
+
+    if (step <= 1)
+    {
+        // Reused across frames of the same size to avoid reallocating the buffer every frame
+        thread_local VisibilityBuffer visibility(frame.width, frame.height);
+        if (visibility.getWidth() != frame.width || visibility.getHeight() != frame.height)
+        {
+            visibility = VisibilityBuffer(frame.width, frame.height);
+        }
+        bool useVisibility = traceSettings.rasterPrimary && traceSettings.maxDepth > 0 && visibility.rasterize(rays, scene, pool);
+        // Taken here: inside the lambda the name would refer to each worker's own (unused) thread_local
+        const VisibilityBuffer *primaryVisibility = useVisibility ? &visibility : nullptr;
+
+        pool.parallelFor(0, frame.height, [&](int y)
+                         {
+            if (!cancelled()) {
+                traceRow(rays, scene, deltaTime, frame, y, 1, primaryVisibility);
+            } });
+        return !cancelled();
+    }
+
+    int blockRows = (frame.height + step - 1) / step;
+    pool.parallelFor(0, blockRows, [&](int blockY)
+                     {
+        if (cancelled()) {
+            return;
+        }
+
+        int y = blockY * step;
+        int blockHeight = std::min(step, frame.height - y);
+        for (int x = 0; x < frame.width; x += step) {
+            Color pixelColor = castRay(rays.origin, rays.direction(x, y), scene, deltaTime);
+
+            int blockWidth = std::min(step, frame.width - x);
+            for (int by = 0; by < blockHeight; ++by) {
+                for (int bx = 0; bx < blockWidth; ++bx) {
+                    frame.at(x + bx, y + by) = pixelColor;
+                }
+            }
+        } });
+
+    return !cancelled();
+}
@@ -0,0 +1,342 @@
+#include "./headers/server.h"
+#include "./headers/camera.h"
+#include "./headers/renderer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Sends the whole buffer, retrying on partial writes; MSG_NOSIGNAL keeps a closed client from raising SIGPIPE
+static bool sendAll(int socket, const std::string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t written = send(socket, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        sent += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// Removes a socket left behind at path by an earlier server. Anything else there is not ours to
+// delete (e.g. a mistyped --server README.md), so it is reported and false is returned.
+static bool removeStaleSocket(const std::string &path)
+{
+    struct stat status;
+    if (lstat(path.c_str(), &status) < 0)
+    {
+        if (errno == ENOENT)
+            return true;
+        std::cerr << "Failed to inspect " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (!S_ISSOCK(status.st_mode))
+    {
+        std::cerr << path << " exists and is not a socket; refusing to replace it" << std::endl;
+        return false;
+    }
+    if (unlink(path.c_str()) < 0)
+    {
+        std::cerr << "Failed to remove " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool parseRenderRequest(const std::string &line, RenderRequest &request, std::string &error)
+{
+    std::istringstream stream(line);
+    std::string command;
+    stream >> command;
+    if (command != "RENDER")
+    {
+        error = "unknown command";
+        return false;
+    }
+
+    stream >> request.position.x >> request.position.y >> request.position.z
+        >> request.target.x >> request.target.y >> request.target.z
+        >> request.width >> request.height >> request.samples;
+    if (!stream)
+    {
+        error = "expected RENDER px py pz tx ty tz width height samples";
+        return false;
+    }
+    if (request.width < 1 || request.height < 1 || request.width > SERVER_MAX_RESOLUTION || request.height > SERVER_MAX_RESOLUTION)
+    {
+        error = "resolution out of range";
+        return false;
+    }
+    if (request.samples < 1 || request.samples > SERVER_MAX_SAMPLES)
+    {
+        error = "sample count out of range";
+        return false;
+    }
+    if (request.position == request.target)
+    {
+        error = "camera position and target must differ";
+        return false;
+    }
+    if (std::abs(glm::normalize(request.target - request.position).y) > SERVER_MAX_VIEW_SLOPE)
+    {
+        error = "camera must not look straight up or down";
+        return false;
+    }
+    return true;
+}
+
+RenderServer::RenderServer(const BVH &scene, ThreadPool &pool, size_t maxBatchSize)
+    : scene(scene), pool(pool), maxBatchSize(maxBatchSize), stopping(false)
+{
+    scheduler = std::thread(&RenderServer::schedulerLoop, this);
+}
+
+RenderServer::~RenderServer()
+{
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        stopping = true;
+    }
+    pendingCondition.notify_all();
+    scheduler.join();
+}
+
+int RenderServer::run(const std::string &socketPath)
+{
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "Socket path too long: " << socketPath << std::endl;
+        return 1;
+    }
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    int listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSocket < 0)
+    {
+        std::cerr << "Failed to create socket: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    if (!removeStaleSocket(socketPath))
+    {
+        close(listenSocket);
+        return 1;
+    }
+    if (bind(listenSocket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(listenSocket, SOMAXCONN) < 0)
+    {
+        std::cerr << "Failed to listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        close(listenSocket);
+        return 1;
+    }
+
+    std::cout << "Render server listening on " << socketPath << std::endl;
+
+    while (true)
+    {
+        int clientSocket = accept(listenSocket, nullptr, nullptr);
+        if (clientSocket < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            std::cerr << "Failed to accept client: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        reapFinishedClients();
+        clients.push_back(Client{std::thread(), clientSocket, false});
+        Client &client = clients.back();
+        client.thread = std::thread(&RenderServer::handleClient, this, &client);
+    }
+
+    close(listenSocket);
+    removeStaleSocket(socketPath);
+    disconnectClients();
+    return 1;
+}
+
+// Joins handlers that have already closed their connection; called with clientsMutex held
+void RenderServer::reapFinishedClients()
+{
+    for (auto client = clients.begin(); client != clients.end();)
+    {
+        if (client->finished)
+        {
+            client->thread.join();
+            client = clients.erase(client);
+        }
+        else
+        {
+            ++client;
+        }
+    }
+}
+
+// Unblocks every handler by shutting its socket down, then waits for all of them, so none
+// outlives the server (or the scene it renders)
+void RenderServer::disconnectClients()
+{
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        for (Client &client : clients)
+        {
+            if (client.socket >= 0)
+            {
+                shutdown(client.socket, SHUT_RDWR);
+            }
+        }
+    }
+
+    // No new clients are accepted any more, so the list can be walked without the lock
+    // (handlers take it to mark themselves finished)
+    for (Client &client : clients)
+    {
+        client.thread.join();
+    }
+    clients.clear();
+}
+
+// Reads newline-terminated requests from one client and answers them in order
+void RenderServer::handleClient(Client *client)
+{
+    int clientSocket = client->socket;
+    std::string buffer;
+    char chunk[4096];
+
+    while (true)
+    {
+        // A client that never sends a newline must not grow the buffer without bound
+        size_t newline = buffer.find('\n');
+        if ((newline == std::string::npos ? buffer.size() : newline) > SERVER_MAX_REQUEST_LENGTH)
+        {
+            sendAll(clientSocket, "ERR request too long\n");
+            break;
+        }
+        if (newline == std::string::npos)
+        {
+            ssize_t received = recv(clientSocket, chunk, sizeof(chunk), 0);
+            if (received < 0 && errno == EINTR)
+                continue;
+            if (received <= 0)
+                break;
+            buffer.append(chunk, static_cast<size_t>(received));
+            continue;
+        }
+
+        std::string line = buffer.substr(0, newline);
+        buffer.erase(0, newline + 1);
+
+        RenderRequest request;
+        std::string error;
+        if (!parseRenderRequest(line, request, error))
+        {
+            if (!sendAll(clientSocket, "ERR " + error + "\n"))
+                break;
+            continue;
+        }
+
+        auto job = std::make_shared<Job>(request);
+        std::future<void> done = job->done.get_future();
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            pending.push_back(job);
+        }
+        pendingCondition.notify_one();
+        done.get();
+
+        std::string image = job->frame.toPPM();
+        if (!sendAll(clientSocket, "OK " + std::to_string(image.size()) + "\n") || !sendAll(clientSocket, image))
+            break;
+    }
+
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    close(clientSocket);
+    client->socket = -1;
+    client->finished = true;
+}
+
+// Collects every request queued while the previous batch was rendering and renders them together
+void RenderServer::schedulerLoop()
+{
+    while (true)
+    {
+        std::vector<std::shared_ptr<Job>> batch;
+        {
+            std::unique_lock<std::mutex> lock(pendingMutex);
+            pendingCondition.wait(lock, [this]()
+                                  { return stopping || !pending.empty(); });
+            if (stopping)
+            {
+                for (auto &job : pending)
+                {
+                    job->done.set_value();
+                }
+                pending.clear();
+                return;
+            }
+            while (!pending.empty() && batch.size() < maxBatchSize)
+            {
+                batch.push_back(pending.front());
+                pending.pop_front();
+            }
+        }
+
+        renderBatch(batch);
+        for (auto &job : batch)
+        {
+            job->done.set_value();
+        }
+    }
+}
+
+// Flattens the rows of every image in the batch into one range so small renders still fill the pool.
+// Single-sample jobs resolve primary visibility with the rasteriser first, like interactive frames.
+void RenderServer::renderBatch(const std::vector<std::shared_ptr<Job>> &batch)
+{
+    std::vector<PrimaryRays> rays;
+    std::vector<int> firstRow;
+    std::vector<std::unique_ptr<VisibilityBuffer>> visibility(batch.size());
+    int totalRows = 0;
+    rays.reserve(batch.size());
+    firstRow.reserve(batch.size());
+    for (size_t index = 0; index < batch.size(); ++index)
+    {
+        const RenderRequest &request = batch[index]->request;
+        Camera view(request.position, request.target, 0.0f);
+        rays.emplace_back(view, request.width, request.height);
+        firstRow.push_back(totalRows);
+        totalRows += request.height;
+
+        if (request.samples == 1 && traceSettings.rasterPrimary && traceSettings.maxDepth > 0)
+        {
+            visibility[index] = std::make_unique<VisibilityBuffer>(request.width, request.height);
+            if (!visibility[index]->rasterize(rays.back(), scene, pool))
+            {
+                visibility[index].reset();
+            }
+        }
+    }
+
+    pool.parallelFor(0, totalRows, [&](int row)
+                     {
+        size_t index = std::upper_bound(firstRow.begin(), firstRow.end(), row) - firstRow.begin() - 1;
+        Job &job = *batch[index];
+        traceRow(rays[index], scene, 0.0f, job.frame, row - firstRow[index], job.request.samples,
+                 visibility[index].get()); });
+}
@@ -0,0 +1,151 @@
+#include "./headers/threadpool.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+ThreadPool::ThreadPool(unsigned int threadCount, bool pinThreads, const std::vector<int> &cores)
+    : stopping(false)
+{
+    std::vector<int> targets = cores.empty() ? allowedCores() : cores;
+    if (threadCount == 0)
+    {
+        threadCount = static_cast<unsigned int>(targets.size());
+    }
+
+    workers.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+        if (pinThreads)
+        {
+            pinToCore(workers.back(), targets[i % targets.size()]);
+        }
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> task)
+{
+    std::packaged_task<void()> packaged(std::move(task));
+    std::future<void> result = packaged.get_future();
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        tasks.push(std::move(packaged));
+    }
+    queueCondition.notify_one();
+    return result;
+}
+
+void ThreadPool::parallelFor(int begin, int end, const std::function<void(int)> &body)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+
+    // Every worker pulls the next index from a shared counter until the range is exhausted
+    std::atomic<int> next(begin);
+    auto drain = [&]()
+    {
+        for (int i = next.fetch_add(1); i < end; i = next.fetch_add(1))
+        {
+            body(i);
+        }
+    };
+
+    unsigned int taskCount = std::min<unsigned int>(size(), static_cast<unsigned int>(end - begin));
+    std::vector<std::future<void>> pending;
+    pending.reserve(taskCount);
+    for (unsigned int i = 0; i < taskCount; ++i)
+    {
+        pending.push_back(submit(drain));
+    }
+
+    for (std::future<void> &task : pending)
+    {
+        task.get();
+    }
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]()
+                                { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty())
+            {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+// CPUs in the process affinity mask; falls back to 0..hardware_concurrency-1 where it is unavailable
+std::vector<int> ThreadPool::allowedCores()
+{
+    std::vector<int> cores;
+#ifdef __linux__
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &cpuSet) == 0)
+    {
+        for (int core = 0; core < CPU_SETSIZE; ++core)
+        {
+            if (CPU_ISSET(core, &cpuSet))
+            {
+                cores.push_back(core);
+            }
+        }
+    }
+#endif
+    if (cores.empty())
+    {
+        unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int core = 0; core < hardwareThreads; ++core)
+        {
+            cores.push_back(static_cast<int>(core));
+        }
+    }
+    return cores;
+}
+
+void ThreadPool::pinToCore(std::thread &thread, int core)
+{
+#ifdef __linux__
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(core, &cpuSet);
+    if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpuSet) != 0)
+    {
+        std::cerr << "Could not pin render thread to core " << core << std::endl;
+    }
+#else
+    (void)thread;
+    (void)core;
+#endif
+}